@@ -3,11 +3,15 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <string.h>
+#include <time.h>
 #include <signal.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <fcntl.h>
 
 #define MAX_STRING 300
 #define MAX_LINE 256 // this is suposed to be 128 but i like to play with long strings
@@ -16,37 +20,128 @@
 #define BOOKMARK_FILE ".bookmarks.txt"
 #define MAX_PATH_ELEMENTS 2048
 #define MAX_PATH_LENGTH 4096
-int argCount = 0;
+#define MAX_TOKENS MAX_LINE
 int bookmarkCount = 0;
-char **pathElements;
+char **pathElements;          // NULL terminated, owned by setPathVariables() and freed by freePathVariables()
 pid_t foregroundProcess = 0;  // holds the foreground process pid
 
-// Structure to store bookmarks
-struct Bookmark
+// Subsystems whose live heap memory is reported by the mem builtin
+enum MemorySubsystem
 {
-    char *args[MAX_LINE / 2 + 1];
-    int argCount;
+    MEM_BOOKMARKS,
+    MEM_PATH,
+    MEM_SUBSYSTEMS
 };
 
-struct Bookmark bookmarks[MAX_BOOKMARKS];
+const char *memorySubsystemNames[MEM_SUBSYSTEMS] = {"bookmarks", "PATH"};
+size_t liveBytes[MEM_SUBSYSTEMS];
+size_t liveBlocks[MEM_SUBSYSTEMS];
 
-bool startsWithDotSlash(const char *str)
+// Every tracked block starts with this header so freeing it can update the counters
+union MemoryHeader
 {
-    size_t len = strlen(str);
-    return (len >= 2 && str[0] == '.' && str[1] == '/');
+    struct
+    {
+        size_t size;
+        enum MemorySubsystem subsystem;
+    } info;
+    max_align_t align;
+};
+
+void *trackedMalloc(enum MemorySubsystem subsystem, size_t size)
+{
+    union MemoryHeader *header = malloc(sizeof(union MemoryHeader) + size);
+
+    if (header == NULL)
+    {
+        fprintf(stderr, "Memory allocation error.\n");
+        exit(EXIT_FAILURE);
+    }
+    header->info.size = size;
+    header->info.subsystem = subsystem;
+    liveBytes[subsystem] += size;
+    liveBlocks[subsystem]++;
+    return header + 1;
 }
 
-void checkQuotes(char *str)
+char *trackedStrdup(enum MemorySubsystem subsystem, const char *str)
 {
-    size_t len = strlen(str);
+    size_t size = strlen(str) + 1;
+    return memcpy(trackedMalloc(subsystem, size), str, size);
+}
 
-    if (len >= 2 && str[0] == '"' && str[len - 1] == '"')
+void trackedFree(void *ptr)
+{
+    if (ptr == NULL)
     {
-        memmove(str, str + 1, len - 2);
-        str[len - 2] = '\0';
+        return;
     }
+
+    union MemoryHeader *header = (union MemoryHeader *)ptr - 1;
+    liveBytes[header->info.subsystem] -= header->info.size;
+    liveBlocks[header->info.subsystem]--;
+    free(header);
 }
 
+// Structure to store bookmarks, each bookmark owns its strings and releases them in freeBookmark()
+struct Bookmark
+{
+    char *command;              // command line, tokenized every time the bookmark runs
+    char *name;                 // NULL for unnamed bookmarks
+    char *deps[MAX_BOOKMARKS];  // names of bookmarks that must run first
+    int depCount;
+};
+
+// Kinds of tokens produced by tokenize()
+enum TokenType
+{
+    TOKEN_WORD,
+    TOKEN_BACKGROUND,       // &
+    TOKEN_PIPE,             // |
+    TOKEN_SEMICOLON,        // ;
+    TOKEN_NEWLINE,          // unescaped newline, separates commands like ;
+    TOKEN_REDIRECT_IN,      // <
+    TOKEN_REDIRECT_OUT,     // >
+    TOKEN_REDIRECT_APPEND,  // >>
+    TOKEN_REDIRECT_ERR      // 2>
+};
+
+// A token points into the tokenized line, only words have text
+struct Token
+{
+    enum TokenType type;
+    char *text;
+};
+
+// A single command with its redirections, as parsed from the tokens between two ';'
+struct Command
+{
+    char *args[MAX_LINE / 2 + 1];
+    int argCount;
+    bool isBackgroundProcess;
+    char *inputFile;
+    char *outputFile;
+    bool appendOutput;
+    char *errorFile;
+};
+
+// States of a bookmark while its task graph is being run
+enum TaskState
+{
+    TASK_WAITING,
+    TASK_RUNNING,
+    TASK_DONE,
+    TASK_FAILED,
+    TASK_CANCELLED
+};
+
+struct Bookmark bookmarks[MAX_BOOKMARKS];
+
+bool startsWithDotSlash(const char *str)
+{
+    size_t len = strlen(str);
+    return (len >= 2 && str[0] == '.' && str[1] == '/');
+}
 
 void removeBeforeDoubleSlash(char *filePath) {
     char *doubleSlash = strstr(filePath, "//");
@@ -65,10 +160,6 @@ void removeBeforeDoubleSlash(char *filePath) {
 
 void searchFiles(char *searchString, char *currentPath, int recursive)
 {
-    checkQuotes(searchString);
-
-
-
     DIR *dir;
     struct dirent *entry;
     struct stat fileStat;
@@ -167,11 +258,22 @@ void saveBookmarksToFile()
 
     for (int i = 0; i < bookmarkCount; i++)
     {
-        for (int j = 0; j < bookmarks[i].argCount; j++)
+        // Named bookmarks are prefixed with "@name:dep1,dep2", unnamed commands that start with '@'
+        // get an empty "@:" header so they are not read back as one
+        if (bookmarks[i].name == NULL && bookmarks[i].command[0] == '@')
+        {
+            fprintf(file, "@: ");
+        }
+        else if (bookmarks[i].name != NULL)
         {
-            fprintf(file, "%s ", bookmarks[i].args[j]);
+            fprintf(file, "@%s:", bookmarks[i].name);
+            for (int j = 0; j < bookmarks[i].depCount; j++)
+            {
+                fprintf(file, j == 0 ? "%s" : ",%s", bookmarks[i].deps[j]);
+            }
+            fprintf(file, " ");
         }
-        fprintf(file, "\n");
+        fprintf(file, "%s\n", bookmarks[i].command);
     }
 
     fclose(file);
@@ -186,7 +288,7 @@ void loadBookmarksFromFile()
         return;
     }
 
-    char line[MAX_LINE];
+    char line[2 * MAX_LINE];
     int index = 0;
 
     while (fgets(line, sizeof(line), file) != NULL && index < MAX_BOOKMARKS)
@@ -194,21 +296,39 @@ void loadBookmarksFromFile()
         // Remove newline character from the end of the line
         line[strcspn(line, "\n")] = '\0';
 
-        // Tokenize the line into arguments
-        char *token = strtok(line, " ");
-        int argIndex = 0;
-
         // Create a new bookmark
         struct Bookmark newBookmark;
+        newBookmark.name = NULL;
+        newBookmark.depCount = 0;
 
-        while (token != NULL && argIndex < MAX_LINE / 2 + 1)
+        // Named bookmarks start with an "@name:dep1,dep2" header, the rest of the line is the command
+        char *command = line;
+        if (line[0] == '@')
         {
-            newBookmark.args[argIndex] = strdup(token);
-            argIndex++;
-            token = strtok(NULL, " ");
+            command = line + strcspn(line, " ");
+            if (*command != '\0')
+            {
+                *command++ = '\0';
+            }
+
+            char *deps = strchr(line, ':');
+            if (deps != NULL)
+            {
+                *deps++ = '\0';
+                char *dep = strtok(deps, ",");
+                while (dep != NULL && newBookmark.depCount < MAX_BOOKMARKS)
+                {
+                    newBookmark.deps[newBookmark.depCount++] = trackedStrdup(MEM_BOOKMARKS, dep);
+                    dep = strtok(NULL, ",");
+                }
+            }
+            if (line[1] != '\0')
+            {
+                newBookmark.name = trackedStrdup(MEM_BOOKMARKS, line + 1);
+            }
         }
 
-        newBookmark.argCount = argIndex;
+        newBookmark.command = trackedStrdup(MEM_BOOKMARKS, command);
         bookmarks[index] = newBookmark;
         index++;
     }
@@ -218,45 +338,143 @@ void loadBookmarksFromFile()
     fclose(file);
 }
 
-void removeFirstChar(char *str)
+void freeBookmark(struct Bookmark *bookmark)
+{
+    trackedFree(bookmark->command);
+    for (int i = 0; i < bookmark->depCount; i++)
+    {
+        trackedFree(bookmark->deps[i]);
+    }
+    trackedFree(bookmark->name);
+}
+
+void deleteBookmark(int index)
 {
-    if (str != NULL && str[0] != '\0')
+    if (index >= 0 && index < bookmarkCount)
+    {
+        freeBookmark(&bookmarks[index]);
+
+        for (int i = index; i < bookmarkCount - 1; i++)
+        {
+            bookmarks[i] = bookmarks[i + 1];
+        }
+
+        bookmarkCount--;
+    }
+    else
     {
-        memmove(str, str + 1, strlen(str));
+        printf("Invalid bookmark index.\n");
     }
 }
 
-void removeLastChar(char *str)
+// Names are stored in the "@name:dep1,dep2" header of the bookmark file, so they can not be empty
+// or contain whitespace or the header separators. A leading '#' is taken by index labels and a
+// leading '-' would be read as an option by bookmark -r.
+bool isValidBookmarkName(const char *name, size_t length)
 {
-    if (str != NULL && str[0] != '\0')
+    if (length == 0 || name[0] == '#' || name[0] == '-')
+    {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++)
     {
-        size_t len = strlen(str);
-        if (len > 0)
+        if (strchr(" \t\n:,", name[i]) != NULL)
         {
-            str[len - 1] = '\0';
+            return false;
         }
     }
+    return true;
 }
 
-void deleteBookmark(int index)
+// Checks every name of a comma separated dependency list, empty entries are rejected as well
+bool isValidDependencyList(const char *deps)
 {
-    if (index >= 0 && index < bookmarkCount)
+    while (1)
     {
-        for (int i = 0; i < bookmarks[index].argCount; i++)
+        size_t length = strcspn(deps, ",");
+        if (!isValidBookmarkName(deps, length))
         {
-            free(bookmarks[index].args[i]);
+            return false;
         }
+        if (deps[length] == '\0')
+        {
+            return true;
+        }
+        deps += length + 1;
+    }
+}
 
-        for (int i = index; i < bookmarkCount - 1; i++)
+// Returns the index of the bookmark with the given name, or -1
+int findBookmark(const char *name)
+{
+    for (int i = 0; i < bookmarkCount; i++)
+    {
+        if (bookmarks[i].name != NULL && !strcmp(bookmarks[i].name, name))
         {
-            bookmarks[i] = bookmarks[i + 1];
+            return i;
         }
+    }
+    return -1;
+}
 
-        bookmarkCount--;
+// Depth-first search over the dependency edges, state is 0 = unvisited, 1 = on stack, 2 = finished.
+// Returns the index of a bookmark on a cycle, or -1.
+int visitDependencies(int index, int state[])
+{
+    state[index] = 1;
+    for (int i = 0; i < bookmarks[index].depCount; i++)
+    {
+        int dep = findBookmark(bookmarks[index].deps[i]);
+        if (dep < 0)
+        {
+            continue; // dependencies may be saved later, they are checked when the graph runs
+        }
+        if (state[dep] == 1)
+        {
+            return dep;
+        }
+        if (state[dep] == 0)
+        {
+            int cycle = visitDependencies(dep, state);
+            if (cycle >= 0)
+            {
+                return cycle;
+            }
+        }
     }
-    else
+    state[index] = 2;
+    return -1;
+}
+
+// Returns the index of a bookmark that is part of a dependency cycle, or -1 if there is none
+int findDependencyCycle()
+{
+    int state[MAX_BOOKMARKS] = {0};
+
+    for (int i = 0; i < bookmarkCount; i++)
     {
-        printf("Invalid bookmark index.\n");
+        if (state[i] == 0)
+        {
+            int cycle = visitDependencies(i, state);
+            if (cycle >= 0)
+            {
+                return cycle;
+            }
+        }
+    }
+    return -1;
+}
+
+// A bookmark file edited by hand can contain cycles, the bookmarks on them are dropped
+void dropDependencyCycles()
+{
+    int index;
+
+    while ((index = findDependencyCycle()) >= 0)
+    {
+        printf("error: bookmark %s is part of a dependency cycle in %s and was dropped\n", bookmarks[index].name,
+               BOOKMARK_FILE);
+        deleteBookmark(index);
     }
 }
 
@@ -299,46 +517,253 @@ void setPathVariables()
 
     if (path != NULL)
     {
-        // Allocate memory for an array of strings
-        pathElements = (char **)malloc(MAX_PATH_ELEMENTS * sizeof(char *));
+        // Copy the PATH variable to a mutable buffer
+        char pathCopy[MAX_PATH_LENGTH];
+        strncpy(pathCopy, path, sizeof(pathCopy) - 1);
+        pathCopy[sizeof(pathCopy) - 1] = '\0'; // Ensure null-termination
+
+        // Allocate an array with room for every element and the terminating NULL
+        int count = 1;
+        for (char *c = pathCopy; *c != '\0'; c++)
+        {
+            count += *c == ':';
+        }
+        if (count > MAX_PATH_ELEMENTS)
+        {
+            count = MAX_PATH_ELEMENTS;
+        }
+        pathElements = trackedMalloc(MEM_PATH, (count + 1) * sizeof(char *));
+
+        // Tokenize the path using ':' as the delimiter
+        char *token = strtok(pathCopy, ":");
+        int i = 0;
 
-        if (pathElements != NULL)
+        // Store each path element in the array
+        while (token != NULL && i < count)
         {
-            // Copy the PATH variable to a mutable buffer
-            char pathCopy[MAX_PATH_LENGTH];
-            strncpy(pathCopy, path, sizeof(pathCopy) - 1);
-            pathCopy[sizeof(pathCopy) - 1] = '\0'; // Ensure null-termination
+            pathElements[i] = trackedStrdup(MEM_PATH, token);
+            token = strtok(NULL, ":");
+            i++;
+        }
+        pathElements[i] = NULL;
+    }
+    else
+    {
+        fprintf(stderr, "PATH variable not set.\n");
+    }
+}
+
+void freePathVariables()
+{
+    for (int i = 0; pathElements != NULL && pathElements[i] != NULL; i++)
+    {
+        trackedFree(pathElements[i]);
+    }
+    trackedFree(pathElements);
+    pathElements = NULL;
+}
+
+// Splits a line into tokens in a single pass. Quotes and escapes are removed in place and every word is
+// terminated inside the line itself, so tokens point into the line and nothing is copied.
+// Returns the number of tokens, or -1 on a syntax error.
+int tokenize(char *line, struct Token tokens[], int maxTokens)
+{
+    enum { LEX_SPACE, LEX_WORD, LEX_SINGLE_QUOTE, LEX_DOUBLE_QUOTE } state = LEX_SPACE;
+    int count = 0;
+    char *write = line; // never passes read, so unquoting can not overwrite unread input
+
+    for (char *read = line; *read != '\0'; read++)
+    {
+        char c = *read;
 
-            // Tokenize the path using ':' as the delimiter
-            char *token = strtok(pathCopy, ":");
-            int i = 0;
+        if (state == LEX_SINGLE_QUOTE)
+        {
+            if (c == '\'')
+                state = LEX_WORD;
+            else
+                *write++ = c;
+            continue;
+        }
+        if (state == LEX_DOUBLE_QUOTE)
+        {
+            if (c == '"')
+                state = LEX_WORD;
+            else if (c == '\\' && read[1] != '\0' && strchr("\"\\$`", read[1]) != NULL)
+                *write++ = *++read;
+            else
+                *write++ = c;
+            continue;
+        }
 
-            // Store each path element in the array
-            while (token != NULL && i < MAX_PATH_ELEMENTS)
+        // Unquoted text, anything that is not a separator or an operator belongs to a word
+        if (c == '\\' && read[1] == '\n')
+        {
+            read++; // line continuation
+            continue;
+        }
+        if (c == '#' && state == LEX_SPACE)
+        {
+            // comment until the end of the line, the newline itself still separates commands
+            while (read[1] != '\0' && read[1] != '\n')
+                read++;
+            continue;
+        }
+        bool errorRedirect = c == '2' && read[1] == '>' && state == LEX_SPACE;
+        if (c != ' ' && c != '\t' && strchr("&|;<>\n", c) == NULL && !errorRedirect)
+        {
+            if (state == LEX_SPACE)
             {
-                pathElements[i] = strdup(token);
-                token = strtok(NULL, ":");
-                i++;
+                if (count == maxTokens)
+                {
+                    printf("error: too many arguments\n");
+                    return -1;
+                }
+                tokens[count].type = TOKEN_WORD;
+                tokens[count++].text = write;
+                state = LEX_WORD;
             }
+
+            if (c == '\'')
+                state = LEX_SINGLE_QUOTE;
+            else if (c == '"')
+                state = LEX_DOUBLE_QUOTE;
+            else if (c == '\\' && read[1] != '\0')
+                *write++ = *++read;
+            else
+                *write++ = c;
+            continue;
         }
-        else
+
+        if (state == LEX_WORD)
+        {
+            *write++ = '\0';
+            state = LEX_SPACE;
+        }
+        if (c == ' ' || c == '\t')
         {
-            fprintf(stderr, "Memory allocation error.\n");
+            continue;
+        }
+
+        if (count == maxTokens)
+        {
+            printf("error: too many arguments\n");
+            return -1;
+        }
+        tokens[count].text = NULL;
+        switch (c)
+        {
+        case '&':
+            tokens[count].type = TOKEN_BACKGROUND;
+            break;
+        case '|':
+            tokens[count].type = TOKEN_PIPE;
+            break;
+        case ';':
+            tokens[count].type = TOKEN_SEMICOLON;
+            break;
+        case '\n':
+            tokens[count].type = TOKEN_NEWLINE;
+            break;
+        case '<':
+            tokens[count].type = TOKEN_REDIRECT_IN;
+            break;
+        case '>':
+            if (read[1] == '>')
+            {
+                read++;
+                tokens[count].type = TOKEN_REDIRECT_APPEND;
+            }
+            else
+            {
+                tokens[count].type = TOKEN_REDIRECT_OUT;
+            }
+            break;
+        default: // 2>
+            read++;
+            tokens[count].type = TOKEN_REDIRECT_ERR;
         }
+        count++;
     }
-    else
+
+    if (state == LEX_SINGLE_QUOTE || state == LEX_DOUBLE_QUOTE)
     {
-        fprintf(stderr, "PATH variable not set.\n");
+        printf("error: unterminated quote\n");
+        return -1;
     }
+    if (state == LEX_WORD)
+    {
+        *write = '\0';
+    }
+    return count;
 }
-// Calls exit if ctrl-D is entered and reads args
-void setup(char inputBuffer[], char *args[], bool *isBackgroundProcess)
+
+// Reads the next command from the tokens, starting at *position.
+// Returns 1 if a command was read, 0 when there are no tokens left and -1 on a syntax error.
+int nextCommand(struct Token tokens[], int tokenCount, int *position, struct Command *command)
 {
+    memset(command, 0, sizeof(*command));
+
+    if (*position >= tokenCount)
+    {
+        return 0;
+    }
+
+    while (*position < tokenCount)
+    {
+        struct Token *token = &tokens[(*position)++];
+
+        switch (token->type)
+        {
+        case TOKEN_WORD:
+            if (command->argCount == MAX_LINE / 2)
+            {
+                printf("error: too many arguments\n");
+                return -1;
+            }
+            command->args[command->argCount++] = token->text;
+            break;
+
+        case TOKEN_BACKGROUND:
+            command->isBackgroundProcess = true;
+            return 1;
+
+        case TOKEN_SEMICOLON:
+        case TOKEN_NEWLINE:
+            return 1;
+
+        case TOKEN_PIPE:
+            printf("error: pipes are not supported\n");
+            return -1;
+
+        default: // redirections take the following word as their file
+            if (*position >= tokenCount || tokens[*position].type != TOKEN_WORD)
+            {
+                printf("error: missing file name after redirection\n");
+                return -1;
+            }
+            char *file = tokens[(*position)++].text;
+            if (token->type == TOKEN_REDIRECT_IN)
+            {
+                command->inputFile = file;
+            }
+            else if (token->type == TOKEN_REDIRECT_ERR)
+            {
+                command->errorFile = file;
+            }
+            else
+            {
+                command->outputFile = file;
+                command->appendOutput = token->type == TOKEN_REDIRECT_APPEND;
+            }
+        }
+    }
+    return 1;
+}
 
+// Prints the prompt and reads a line, calls exit if ctrl-D is entered
+void setup(char inputBuffer[])
+{
     int length; // # of characters in the command line
-    int i;      // loop index for accessing inputBuffer array
-    int start;  // index where beginning of next command parameter is
-    int ct = 0; // index of where to place the next parameter into args[]
 
     // Use ANSI escape code to set text color to green
     printf("\033[1;31m");
@@ -352,9 +777,9 @@ void setup(char inputBuffer[], char *args[], bool *isBackgroundProcess)
        which is the user's screen in this case. inputBuffer by itself is the
        same as &inputBuffer[0], i.e. the starting address of where to store
        the command that is read, and length holds the number of characters
-       read in. inputBuffer is not a null terminated C-string. */
+       read in. inputBuffer is not a null terminated C-string until we add
+       the terminator, which is why it has room for MAX_LINE + 1 characters. */
 
-    start = -1;
     if (length == 0)
         exit(0); /* ^d was entered, end of user command stream */
 
@@ -368,124 +793,99 @@ void setup(char inputBuffer[], char *args[], bool *isBackgroundProcess)
         exit(-1); /* terminate with error code of -1 */
     }
 
-    // printf(">>%s<<", inputBuffer);
-    for (i = 0; i < length; i++)
-    { /* examine every character in the inputBuffer */
-        switch (inputBuffer[i])
-        {
-        case ' ':
-        case '\t': /* argument separators */
-            if (start != -1)
-            {
-                args[ct] = &inputBuffer[start]; /* set up pointer */
-                ct++;
-            }
-            inputBuffer[i] = '\0'; /* add a null char; make a C string */
-            start = -1;
-            break;
-
-        case '\n': /* should be the final char examined */
-            if (start != -1)
-            {
-                args[ct] = &inputBuffer[start];
-                ct++;
-            }
-            inputBuffer[i] = '\0';
-            args[ct] = NULL; /* no more arguments to this command */
-            break;
-
-        default: /* some other character */
-            if (start == -1)
-                start = i;
-            if (inputBuffer[i] == '&')
-            {
-                *isBackgroundProcess = true;
-                inputBuffer[i - 1] = '\0';
-            }
-        }            /* end of switch */
-    }                /* end of for */
-    args[ct] = NULL; /* just in case the input line was > 80 */
-    argCount = ct;
-}
-
-
-
-void removeQuote(char *str) {
-    int len = strlen(str);
-    int i, j;
-
-    for (i = 0, j = 0; i < len; i++) {
-        if (str[i] != '"') {
-            str[j] = str[i];
-            j++;
-        }
-    }
-
-    str[j] = '\0';
+    inputBuffer[length < 0 ? 0 : length] = '\0';
 }
 
-
-
-void forkProcess(char *args[], bool isBackgroundProcess, bool isLocalProcess)
+// Finds the executable for a command, either in the current directory or in the path variable
+bool resolveCommand(const char *command, bool isLocalProcess, char *fullPath, size_t size)
 {
-
-    int size = 0; 
-    while(args[++size] != NULL);
-
-    for (int i = 1; i < size; i++) {
-        removeQuote(args[i]);
-    }
-
-    int status;
-    char fullPath[MAX_LINE];
-
-    // If the process is not local, it searches the path variable
     if (isLocalProcess)
     {
         char currentDir[1024];
         if (getcwd(currentDir, sizeof(currentDir)) == NULL)
         {
             perror("getcwd");
-            exit(EXIT_FAILURE);
+            return false;
         }
-        char fullPath[MAX_PATH_LENGTH];
-        snprintf(fullPath, sizeof(fullPath), "%s/%s", currentDir, args[0]);
+        snprintf(fullPath, size, "%s/%s", currentDir, command);
+        return true;
     }
-    else
+
+    // Iterate through each directory in pathElements
+    for (int i = 0; pathElements != NULL && pathElements[i] != NULL; ++i)
     {
-        // Iterate through each directory in pathElements
-        for (int i = 0; pathElements[i] != NULL; ++i)
-        {
-            // Create the full path to the executable
-            char testPath[MAX_LINE];
-            snprintf(testPath, sizeof(fullPath), "%s/%s", pathElements[i], args[0]);
+        // Create the full path to the executable
+        char testPath[MAX_PATH_LENGTH];
+        snprintf(testPath, sizeof(testPath), "%s/%s", pathElements[i], command);
 
-            // Check if the file exists and is executable
-            if (access(testPath, X_OK) == 0)
-            {
-                snprintf(fullPath, sizeof(fullPath), "%s/%s", pathElements[i], args[0]);
-                break;
-            }
-            if (pathElements[i + 1] == NULL)
-            {
-                printf("error: command not found\n");
-                return;
-            }
+        // Check if the file exists and is executable
+        if (access(testPath, X_OK) == 0)
+        {
+            snprintf(fullPath, size, "%s", testPath);
+            return true;
         }
     }
 
-    int fork_pid = fork();
-    if (fork_pid == -1)
+    printf("error: command not found\n");
+    return false;
+}
+
+// Opens a redirection target in place of one of the standard streams, exits the child on failure
+void redirectStream(const char *file, const char *mode, FILE *stream)
+{
+    if (freopen(file, mode, stream) == NULL)
+    {
+        perror(file);
+        _exit(EXIT_FAILURE);
+    }
+}
+
+// Applies the redirections of a command and replaces the child process with it
+void execCommand(struct Command *command, const char *fullPath)
+{
+    if (command->inputFile != NULL)
+    {
+        redirectStream(command->inputFile, "r", stdin);
+    }
+    if (command->outputFile != NULL)
+    {
+        redirectStream(command->outputFile, command->appendOutput ? "a" : "w", stdout);
+    }
+    if (command->errorFile != NULL)
+    {
+        redirectStream(command->errorFile, "w", stderr);
+    }
+
+    command->args[command->argCount] = NULL;
+    execv(fullPath, command->args);
+    perror("execv");
+    _exit(EXIT_FAILURE); // exit() would run the shell's exit hooks in the child
+}
+
+void forkProcess(struct Command *command, bool isLocalProcess)
+{
+    int status;
+    char fullPath[MAX_PATH_LENGTH];
+
+    // If the process is not local, it searches the path variable
+    if (!resolveCommand(command->args[0], isLocalProcess, fullPath, sizeof(fullPath)))
+    {
+        return;
+    }
+
+    fflush(stdout); // the child must not inherit unwritten output
+    int fork_pid = fork();
+    if (fork_pid == -1)
     {
         perror("fork");
         printf("\tLOKISLOG ERROR:\tError while creating child process!");
-        return 1;
+        return;
     }
 
     if (fork_pid)
     {
         // This is the parent process
-        if (!isBackgroundProcess)
+        if (!command->isBackgroundProcess)
         {
             if (waitpid(fork_pid, &status, 0) <= 0)
             {
@@ -496,215 +896,749 @@ void forkProcess(char *args[], bool isBackgroundProcess, bool isLocalProcess)
     else
     {
         // This is the child process
-        if (isBackgroundProcess)
+        if (command->isBackgroundProcess)
         {
             foregroundProcess = getpid();
-            argCount--; // Dont count & as a argument
-            args[argCount] = NULL;
             // Redirect standard input, output, and error to /dev/null so output is not printed
             freopen("/dev/null", "r", stdin);
             freopen("/dev/null", "w", stdout);
             freopen("/dev/null", "w", stderr);
         }
-        if (argCount > 2)
+        execCommand(command, fullPath);
+    }
+}
+
+void executeLine(char *line);
+
+// Runs the commands of a bookmark the same way as a typed line, builtins included
+void runBookmark(int index)
+{
+    static int depth = 0; // bookmarks that run other bookmarks
+    char line[2 * MAX_LINE];
+
+    if (depth >= MAX_BOOKMARKS)
+    {
+        printf("error: bookmarks are nested too deeply\n");
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%s", bookmarks[index].command);
+    depth++;
+    executeLine(line);
+    depth--;
+}
+
+const char *bookmarkLabel(int index)
+{
+    static char label[16];
+
+    if (bookmarks[index].name != NULL)
+    {
+        return bookmarks[index].name;
+    }
+    snprintf(label, sizeof(label), "#%d", index);
+    return label;
+}
+
+double elapsedSeconds(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Marks the bookmark and everything it depends on as part of the graph to run
+bool collectTasks(int index, bool needed[])
+{
+    if (needed[index])
+    {
+        return true;
+    }
+    needed[index] = true;
+
+    for (int i = 0; i < bookmarks[index].depCount; i++)
+    {
+        int dep = findBookmark(bookmarks[index].deps[i]);
+        if (dep < 0)
+        {
+            printf("error: bookmark %s depends on unknown bookmark %s\n", bookmarkLabel(index), bookmarks[index].deps[i]);
+            return false;
+        }
+        if (!collectTasks(dep, needed))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool dependsOn(int index, int dep)
+{
+    for (int i = 0; i < bookmarks[index].depCount; i++)
+    {
+        if (findBookmark(bookmarks[index].deps[i]) == dep)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Cancels every waiting task downstream of a failed one
+void cancelDependents(int failed, bool needed[], enum TaskState state[])
+{
+    for (int i = 0; i < bookmarkCount; i++)
+    {
+        if (needed[i] && state[i] == TASK_WAITING && dependsOn(i, failed))
         {
-            if (!strcmp(args[argCount - 2], ">"))
+            state[i] = TASK_CANCELLED;
+            printf("[%s] cancelled\n", bookmarkLabel(i));
+            cancelDependents(i, needed, state);
+        }
+    }
+}
+
+// Runs a bookmark after all of its dependencies, independent bookmarks run concurrently up to jobs at a time
+void runBookmarkGraph(const char *name, int jobs)
+{
+    int root = findBookmark(name);
+    if (root < 0)
+    {
+        printf("error: no bookmark named %s\n", name);
+        return;
+    }
+
+    bool needed[MAX_BOOKMARKS] = {false};
+    if (!collectTasks(root, needed))
+    {
+        return;
+    }
+
+    enum TaskState state[MAX_BOOKMARKS];
+    int pending[MAX_BOOKMARKS];        // dependencies that have not finished yet
+    pid_t pids[MAX_BOOKMARKS];
+    struct timespec started[MAX_BOOKMARKS];
+    double pathTime[MAX_BOOKMARKS];    // longest chain of durations ending at this task
+    int pathPrev[MAX_BOOKMARKS];       // previous task on that chain
+    int running = 0;
+    struct timespec graphStart, now;
+
+    for (int i = 0; i < bookmarkCount; i++)
+    {
+        state[i] = TASK_WAITING;
+        pending[i] = needed[i] ? bookmarks[i].depCount : 0;
+        pathTime[i] = 0;
+        pathPrev[i] = -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &graphStart);
+
+    while (1)
+    {
+        // Start every ready task while there are free job slots
+        for (int i = 0; i < bookmarkCount && running < jobs; i++)
+        {
+            if (!needed[i] || state[i] != TASK_WAITING || pending[i] > 0)
             {
-                freopen(args[argCount - 1], "w", stdout);
-                args[argCount - 2] = NULL;
-                execv(fullPath, args);
+                continue;
             }
-            else if (!strcmp(args[argCount - 2], ">>"))
+
+            // Every task is a single command, a trailing & is ignored since tasks already run alongside the shell
+            char line[2 * MAX_LINE];
+            struct Token tokens[MAX_TOKENS];
+            struct Command command, extra;
+            int position = 0;
+
+            snprintf(line, sizeof(line), "%s", bookmarks[i].command);
+            int tokenCount = tokenize(line, tokens, MAX_TOKENS);
+            int count = 0;
+            if (tokenCount > 0 && nextCommand(tokens, tokenCount, &position, &command) > 0)
             {
-                freopen(args[argCount - 1], "a", stdout);
-                args[argCount - 2] = NULL;
-                execv(fullPath, args);
+                count = command.argCount;
+                if (nextCommand(tokens, tokenCount, &position, &extra) != 0)
+                {
+                    printf("[%s] error: a task must be a single command\n", bookmarkLabel(i));
+                    count = 0;
+                }
             }
-            else if (!strcmp(args[argCount - 2], "<"))
+
+            char fullPath[MAX_PATH_LENGTH];
+            pid_t pid = -1;
+            if (count > 0 && resolveCommand(command.args[0], startsWithDotSlash(command.args[0]), fullPath, sizeof(fullPath)))
             {
-                freopen(args[argCount - 1], "r", stdin);
-                args[argCount - 2] = NULL;
-                execv(fullPath, args);
+                printf("[%s] started\n", bookmarkLabel(i));
+                fflush(stdout);
+                pid = fork();
+                if (pid == -1)
+                {
+                    perror("fork");
+                }
+                else if (pid == 0)
+                {
+                    execCommand(&command, fullPath);
+                }
             }
-            else if (!strcmp(args[argCount - 2], "2>"))
+
+            if (pid == -1)
             {
-                freopen(args[argCount - 1], "w", stderr);
-                args[argCount - 2] = NULL;
-                execv(fullPath, args);
+                state[i] = TASK_FAILED;
+                printf("[%s] failed to start\n", bookmarkLabel(i));
+                cancelDependents(i, needed, state);
+                continue;
             }
-            else
+
+            pids[i] = pid;
+            state[i] = TASK_RUNNING;
+            clock_gettime(CLOCK_MONOTONIC, &started[i]);
+            running++;
+        }
+
+        if (running == 0)
+        {
+            // Nothing can start any more, tasks that are still waiting could only be stuck on each other
+            for (int i = 0; i < bookmarkCount; i++)
             {
-                execv(fullPath, args);
-                perror("execv");
-                exit(EXIT_FAILURE);
+                if (needed[i] && state[i] == TASK_WAITING)
+                {
+                    printf("[%s] error: waiting on a dependency cycle\n", bookmarkLabel(i));
+                }
             }
+            break;
         }
-        else
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
         {
-            execv(fullPath, args);
-            perror("execv");
-            exit(EXIT_FAILURE);
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("waitpid");
+            break;
         }
-    }
-}
 
-int main()
-{
+        int task = -1;
+        for (int i = 0; i < bookmarkCount; i++)
+        {
+            if (state[i] == TASK_RUNNING && pids[i] == pid)
+            {
+                task = i;
+            }
+        }
+        if (task < 0)
+        {
+            continue; // a background process started outside the graph
+        }
 
-    setPathVariables();
-    loadBookmarksFromFile();
-    signal(SIGTSTP, sighandler);
-    char inputBuffer[MAX_LINE];
-    bool isBackgroundProcess; // equals 1 if a command is followed by &
-    char *args[MAX_LINE / 2 + 1];
+        running--;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double duration = elapsedSeconds(&started[task], &now);
 
-    // print opening text
-    printf("\033[1;31m");
-    printf("░█░░░█▀█░█░█░▀█▀░█▀▀░█░█░█▀▀░█░░░█░░\n");
-    printf("░█░░░█░█░█▀▄░░█░░▀▀█░█▀█░█▀▀░█░░░█░░\n");
-    printf("░▀▀▀░▀▀▀░▀░▀░▀▀▀░▀▀▀░▀░▀░▀▀▀░▀▀▀░▀▀▀\n");
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            state[task] = TASK_FAILED;
+            printf("[%s] failed after %.3fs (status %d)\n", bookmarkLabel(task), duration,
+                   WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+            cancelDependents(task, needed, state);
+            continue;
+        }
 
-    while (1)
-    {
-        isBackgroundProcess = false;
-        setup(inputBuffer, args, &isBackgroundProcess);
+        state[task] = TASK_DONE;
+        printf("[%s] finished in %.3fs\n", bookmarkLabel(task), duration);
 
-        if (!strcmp(args[0], "exit") || !strcmp(args[0], "killoki"))
+        // Every dependency of this task is done, so its longest chain is final
+        for (int i = 0; i < bookmarks[task].depCount; i++)
         {
-            saveBookmarksToFile();
-            exit(3);
+            int dep = findBookmark(bookmarks[task].deps[i]);
+            if (pathTime[dep] > pathTime[task])
+            {
+                pathTime[task] = pathTime[dep];
+                pathPrev[task] = dep;
+            }
         }
-        else if (startsWithDotSlash(args[0]))
+        pathTime[task] += duration;
+
+        for (int i = 0; i < bookmarkCount; i++)
         {
-            removeFirstChar(args[0]);
-            removeFirstChar(args[0]);
-            args[1] = NULL;
-            forkProcess(args, isBackgroundProcess, true);
+            if (needed[i] && state[i] == TASK_WAITING)
+            {
+                for (int j = 0; j < bookmarks[i].depCount; j++)
+                {
+                    if (findBookmark(bookmarks[i].deps[j]) == task)
+                    {
+                        pending[i]--;
+                    }
+                }
+            }
         }
-        else if (!strcmp(args[0], "cd"))
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // The critical path ends at the finished task with the longest chain
+    int last = -1;
+    for (int i = 0; i < bookmarkCount; i++)
+    {
+        if (state[i] == TASK_DONE && (last < 0 || pathTime[i] > pathTime[last]))
         {
-            changeDirectory(args);
+            last = i;
         }
-        else if (!strcmp(args[0], "13killoki"))
+    }
+    if (last >= 0)
+    {
+        int chain[MAX_BOOKMARKS];
+        int length = 0;
+        for (int i = last; i >= 0; i = pathPrev[i])
         {
-            printf("\033[1;31m");
-            printf("  ░░███╗░░██████╗░██╗░░██╗██╗██╗░░░░░██╗░░░░░░█████╗░██╗░░██╗██╗ \n");
-            printf("  ░████║░░╚════██╗██║░██╔╝██║██║░░░░░██║░░░░░██╔══██╗██║░██╔╝██║  \n");
-            printf("  ██╔██║░░░█████╔╝█████═╝░██║██║░░░░░██║░░░░░██║░░██║█████═╝░██║ \n");
-            printf("  ╚═╝██║░░░╚═══██╗██╔═██╗░██║██║░░░░░██║░░░░░██║░░██║██╔═██╗░██║ \n");
-            printf("  ███████╗██████╔╝██║░╚██╗██║███████╗███████╗╚█████╔╝██║░╚██╗██║  \n");
-            printf("  ╚══════╝╚═════╝ ╚═╝  ╚═╝╚═╝╚══════╝╚══════╝ ╚════╝ ╚═╝  ╚═╝╚═╝  \n");
+            chain[length++] = i;
         }
-        else if (!strcmp(args[0], "bookmark"))
+        printf("critical path (%.3fs):", pathTime[last]);
+        for (int i = length - 1; i >= 0; i--)
         {
-            if (argCount >= 2)
+            printf(i == length - 1 ? " %s" : " -> %s", bookmarkLabel(chain[i]));
+        }
+        printf("\n");
+    }
+    printf("%s %s in %.3fs\n", bookmarkLabel(root), state[root] == TASK_DONE ? "finished" : "failed",
+           elapsedSeconds(&graphStart, &now));
+}
+
+// Exit hook, registered once in main: saves the bookmarks and releases everything the shell owns
+void shutdownShell()
+{
+    saveBookmarksToFile();
+
+    for (int i = 0; i < bookmarkCount; i++)
+    {
+        freeBookmark(&bookmarks[i]);
+    }
+    bookmarkCount = 0;
+    freePathVariables();
+}
+
+// Prints the live heap memory of every subsystem
+void printMemoryUsage()
+{
+    size_t totalBytes = 0;
+    size_t totalBlocks = 0;
+
+    for (int i = 0; i < MEM_SUBSYSTEMS; i++)
+    {
+        printf("%-10s %8zu bytes in %zu blocks\n", memorySubsystemNames[i], liveBytes[i], liveBlocks[i]);
+        totalBytes += liveBytes[i];
+        totalBlocks += liveBlocks[i];
+    }
+    printf("%-10s %8zu bytes in %zu blocks\n", "total", totalBytes, totalBlocks);
+}
+
+// Commands run by the shell itself instead of a child process
+const char *builtinCommands[] = {"exit", "killoki", "cd", "mem", "13killoki", "bookmark", "search"};
+
+bool isBuiltin(const char *name)
+{
+    for (size_t i = 0; i < sizeof(builtinCommands) / sizeof(builtinCommands[0]); i++)
+    {
+        if (!strcmp(name, builtinCommands[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Points one of the shell's own standard descriptors at a file while a builtin runs.
+// Returns a copy of the original descriptor to restore afterwards, or -1 on failure.
+int redirectDescriptor(const char *file, int flags, int target)
+{
+    int fd = open(file, flags, 0666);
+    if (fd < 0)
+    {
+        perror(file);
+        return -1;
+    }
+
+    int saved = dup(target);
+    dup2(fd, target);
+    close(fd);
+    return saved;
+}
+
+// Runs a builtin command in the shell process
+void runBuiltin(struct Command *command)
+{
+    char **args = command->args;
+    int argCount = command->argCount;
+
+    if (!strcmp(args[0], "exit") || !strcmp(args[0], "killoki"))
+    {
+        exit(3); // bookmarks are saved by shutdownShell
+    }
+    else if (!strcmp(args[0], "cd"))
+    {
+        changeDirectory(args);
+    }
+    else if (!strcmp(args[0], "mem"))
+    {
+        printMemoryUsage();
+    }
+    else if (!strcmp(args[0], "13killoki"))
+    {
+        printf("\033[1;31m");
+        printf("  ░░███╗░░██████╗░██╗░░██╗██╗██╗░░░░░██╗░░░░░░█████╗░██╗░░██╗██╗ \n");
+        printf("  ░████║░░╚════██╗██║░██╔╝██║██║░░░░░██║░░░░░██╔══██╗██║░██╔╝██║  \n");
+        printf("  ██╔██║░░░█████╔╝█████═╝░██║██║░░░░░██║░░░░░██║░░██║█████═╝░██║ \n");
+        printf("  ╚═╝██║░░░╚═══██╗██╔═██╗░██║██║░░░░░██║░░░░░██║░░██║██╔═██╗░██║ \n");
+        printf("  ███████╗██████╔╝██║░╚██╗██║███████╗███████╗╚█████╔╝██║░╚██╗██║  \n");
+        printf("  ╚══════╝╚═════╝ ╚═╝  ╚═╝╚═╝╚══════╝╚══════╝ ╚════╝ ╚═╝  ╚═╝╚═╝  \n");
+    }
+    else if (!strcmp(args[0], "bookmark"))
+    {
+        if (argCount >= 2)
+        {
+            if (!strcmp(args[1], "-l"))
             {
-                if (!strcmp(args[1], "-l"))
+                // List bookmarks
+                for (int i = 0; i < bookmarkCount; i++)
                 {
-                    // List bookmarks
-                    for (int i = 0; i < bookmarkCount; i++)
+                    printf("%d ", i);
+                    if (bookmarks[i].name != NULL)
                     {
-                        printf("%d \"", i);
-                        for (int j = 0; j < bookmarks[i].argCount; j++)
+                        printf("%s ", bookmarks[i].name);
+                        for (int j = 0; j < bookmarks[i].depCount; j++)
                         {
-                            printf("%s ", bookmarks[i].args[j]);
+                            printf(j == 0 ? "(%s" : ",%s", bookmarks[i].deps[j]);
                         }
-                        printf("\"\n");
+                        printf(bookmarks[i].depCount > 0 ? ") \"" : "\"");
                     }
-                }
-                else if (!strcmp(args[1], "-i") && argCount >= 3)
-                {
-                    // Execute bookmark by index
-                    int index = atoi(args[2]);
-                    if (!strcmp(bookmarks[index].args[bookmarks[index].argCount - 1], "&"))
+                    else
                     {
-                        isBackgroundProcess = true;
+                        printf("\"");
                     }
-                    argCount = bookmarks[index].argCount;
-
-                    // printf("index is: %d, argcount is: %d, isBackground is : %d\n", index, bookmarks[index].argCount, isBackgroundProcess);
-                    // for (int i = 0; i < bookmarks[index].argCount; i++)
-                    // {
-                    //     printf("arg%d : %s\n", i, bookmarks[index].args[i]);
-                    // }
-
-                    bookmarks[index].args[argCount] = NULL;
-
-                    forkProcess(bookmarks[index].args, isBackgroundProcess, false);
+                    printf("%s\"\n", bookmarks[i].command);
                 }
-                else if (!strcmp(args[1], "-d") && argCount >= 3)
+            }
+            else if (!strcmp(args[1], "-i") && argCount >= 3)
+            {
+                // Execute bookmark by index
+                int index = atoi(args[2]);
+                if (index < 0 || index >= bookmarkCount)
                 {
-                    // Delete bookmark by index
-                    int index = atoi(args[2]);
-                    deleteBookmark(index);
-                    printf("Bookmark deleted.\n");
+                    printf("Invalid bookmark index.\n");
                 }
                 else
                 {
-                    // The procedure for adding bookmarks
-                    char *bookmarkCommand[MAX_LINE / 2 + 1];
+                    runBookmark(index);
+                }
+            }
+            else if (!strcmp(args[1], "-r"))
+            {
+                // Run a bookmark together with everything it depends on: bookmark -r [-j <jobs>] <name>,
+                // the options may come before or after the name
+                const char *name = NULL;
+                int jobs = 1;
+                bool valid = true;
 
-                    for (int i = 1, j = 0; i < argCount; i++, j++)
+                for (int i = 2; i < argCount && valid; i++)
+                {
+                    if (!strcmp(args[i], "-j"))
                     {
-                        bookmarkCommand[j] = strdup(args[i]);
-
-                        // Remove quotes from the first argument
-                        if (i == 1)
-                        {
-                            removeFirstChar(bookmarkCommand[j]);
-                        }
-                        if (i == argCount - 1)
-                        {
-                            removeLastChar(bookmarkCommand[j]);
-                        }
+                        char *end;
+                        jobs = i + 1 < argCount ? strtol(args[++i], &end, 10) : 0;
+                        valid = jobs >= 1 && *end == '\0';
                     }
-
-                    for (int i = 0; i < argCount - 1; i++)
+                    else if (args[i][0] == '-' || name != NULL)
+                    {
+                        valid = false;
+                    }
+                    else
                     {
-                        bookmarks[bookmarkCount].args[i] = strdup(bookmarkCommand[i]);
+                        name = args[i];
                     }
-                    bookmarks[bookmarkCount].argCount = argCount - 1;
-                    bookmarkCount++;
+                }
 
-                    printf("Added bookmark\n");
+                if (!valid || name == NULL)
+                {
+                    printf("Invalid bookmark command. Usage: bookmark -r [-j <jobs>] <name>\n");
+                }
+                else
+                {
+                    runBookmarkGraph(name, jobs);
                 }
             }
-            else
+            else if (!strcmp(args[1], "-d") && argCount >= 3)
             {
-                printf("Invalid bookmark command. Usage: bookmark [options] <command>\n");
+                // Delete bookmark by index
+                int index = atoi(args[2]);
+                deleteBookmark(index);
+                printf("Bookmark deleted.\n");
             }
-        }
-        else if (!strcmp(args[0], "search"))
-        {
-            if (argCount >= 2)
+            else
             {
-                bool recursive = false;
-                const char *searchString = args[1];
+                // The procedure for adding bookmarks, optionally named and with dependencies:
+                // bookmark [-n <name>] [-a <dep1,dep2>] "<command>"
+                char *name = NULL;
+                char *deps = NULL;
+                int first = 1;
+
+                while (first + 1 < argCount && (!strcmp(args[first], "-n") || !strcmp(args[first], "-a")))
+                {
+                    if (!strcmp(args[first], "-n"))
+                    {
+                        name = args[first + 1];
+                    }
+                    else
+                    {
+                        deps = args[first + 1];
+                    }
+                    first += 2;
+                }
 
-                if (argCount >= 3 && !strcmp(args[1], "-r"))
+                // The command has to be a single quoted word, its quotes are already gone and joining
+                // several words back together would change what they mean
+                if (first != argCount - 1 || (deps != NULL && name == NULL))
+                {
+                    printf("Invalid bookmark command. Usage: bookmark [-n <name>] [-a <dep1,dep2>] \"<command>\"\n");
+                    return;
+                }
+                if (name != NULL && !isValidBookmarkName(name, strlen(name)))
+                {
+                    printf("Invalid bookmark name \"%s\".\n", name);
+                    return;
+                }
+                if (deps != NULL && !isValidDependencyList(deps))
+                {
+                    printf("Invalid dependency list \"%s\".\n", deps);
+                    return;
+                }
+                if (strchr(args[first], '\n') != NULL)
                 {
-                    recursive = true;
-                    searchString = args[2];
+                    printf("Invalid bookmark command, the bookmark file stores one bookmark per line.\n");
+                    return;
                 }
 
-                char currentPath[1000];
-                if (getcwd(currentPath, sizeof(currentPath)) == NULL)
+                // A bookmark saved under an existing name replaces it
+                int index = name != NULL ? findBookmark(name) : -1;
+                if (index < 0 && bookmarkCount >= MAX_BOOKMARKS)
                 {
-                    perror("getcwd");
+                    printf("Bookmark limit reached.\n");
+                    return;
                 }
 
-                searchFiles(searchString, currentPath, recursive);
+                struct Bookmark newBookmark;
+                newBookmark.depCount = 0;
+                newBookmark.name = name != NULL ? trackedStrdup(MEM_BOOKMARKS, name) : NULL;
+
+                newBookmark.command = trackedStrdup(MEM_BOOKMARKS, args[first]);
+
+                for (char *dep = deps != NULL ? strtok(deps, ",") : NULL; dep != NULL && newBookmark.depCount < MAX_BOOKMARKS;
+                     dep = strtok(NULL, ","))
+                {
+                    newBookmark.deps[newBookmark.depCount++] = trackedStrdup(MEM_BOOKMARKS, dep);
+                }
+
+                // Cycles are rejected here so that running a graph never has to deal with them
+                struct Bookmark previous;
+                bool replaced = index >= 0;
+                if (replaced)
+                {
+                    previous = bookmarks[index];
+                }
+                else
+                {
+                    index = bookmarkCount++;
+                }
+                bookmarks[index] = newBookmark;
+
+                if (findDependencyCycle() >= 0)
+                {
+                    printf("error: bookmark %s would create a dependency cycle\n", name);
+                    freeBookmark(&bookmarks[index]);
+                    if (replaced)
+                    {
+                        bookmarks[index] = previous;
+                    }
+                    else
+                    {
+                        bookmarkCount--;
+                    }
+                    return;
+                }
+                if (replaced)
+                {
+                    freeBookmark(&previous);
+                }
+
+                printf("Added bookmark\n");
             }
-            else
+        }
+        else
+        {
+            printf("Invalid bookmark command. Usage: bookmark [options] <command>\n");
+        }
+    }
+    else if (!strcmp(args[0], "search"))
+    {
+        if (argCount >= 2)
+        {
+            bool recursive = false;
+            const char *searchString = args[1];
+
+            if (argCount >= 3 && !strcmp(args[1], "-r"))
+            {
+                recursive = true;
+                searchString = args[2];
+            }
+
+            char currentPath[1000];
+            if (getcwd(currentPath, sizeof(currentPath)) == NULL)
             {
-                printf("Invalid search command. Usage: search [-r] <search_string>\n");
+                perror("getcwd");
             }
+
+            searchFiles(searchString, currentPath, recursive);
         }
         else
         {
-            forkProcess(args, isBackgroundProcess, false);
-            atexit(saveBookmarksToFile);
+            printf("Invalid search command. Usage: search [-r] <search_string>\n");
+        }
+    }
+}
+
+// Runs a builtin or an external command, builtins get the same redirections as a child process would
+void executeCommand(struct Command *command)
+{
+    if (!isBuiltin(command->args[0]))
+    {
+        forkProcess(command, startsWithDotSlash(command->args[0]));
+        return;
+    }
+    if (command->isBackgroundProcess)
+    {
+        printf("error: %s is a builtin and can not run in the background\n", command->args[0]);
+        return;
+    }
+
+    int saved[3] = {-1, -1, -1}; // copies of stdin, stdout and stderr
+    bool redirected = true;
+
+    fflush(stdout);
+    fflush(stderr);
+    if (command->inputFile != NULL)
+    {
+        saved[0] = redirectDescriptor(command->inputFile, O_RDONLY, STDIN_FILENO);
+        redirected = saved[0] >= 0;
+    }
+    if (redirected && command->outputFile != NULL)
+    {
+        int flags = O_WRONLY | O_CREAT | (command->appendOutput ? O_APPEND : O_TRUNC);
+        saved[1] = redirectDescriptor(command->outputFile, flags, STDOUT_FILENO);
+        redirected = saved[1] >= 0;
+    }
+    if (redirected && command->errorFile != NULL)
+    {
+        saved[2] = redirectDescriptor(command->errorFile, O_WRONLY | O_CREAT | O_TRUNC, STDERR_FILENO);
+        redirected = saved[2] >= 0;
+    }
+
+    if (redirected)
+    {
+        runBuiltin(command);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < 3; i++)
+    {
+        if (saved[i] >= 0)
+        {
+            dup2(saved[i], i);
+            close(saved[i]);
         }
     }
+}
+
+// Tokenizes a line and runs the commands in it, the same way for interactive input and scripts
+void executeLine(char *line)
+{
+    struct Token tokens[MAX_TOKENS];
+    struct Command command;
+    int position = 0;
+
+    int tokenCount = tokenize(line, tokens, MAX_TOKENS);
+    int result;
+
+    while (tokenCount > 0 && (result = nextCommand(tokens, tokenCount, &position, &command)) != 0)
+    {
+        if (result < 0)
+        {
+            // A syntax error only discards the rest of its own line
+            while (position < tokenCount && tokens[position++].type != TOKEN_NEWLINE)
+                ;
+        }
+        else if (command.argCount > 0)
+        {
+            executeCommand(&command);
+        }
+    }
+}
+
+// Runs every line of a script file
+void runScript(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+
+    if (file == NULL)
+    {
+        perror(fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    char line[MAX_LINE + 1];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNumber++;
+
+        // A line that did not fit is skipped as a whole instead of running its pieces
+        int c;
+        if (strchr(line, '\n') == NULL && (c = fgetc(file)) != EOF && c != '\n')
+        {
+            printf("error: %s:%d: line is longer than %d characters\n", fileName, lineNumber, MAX_LINE);
+            while (c != EOF && c != '\n')
+                c = fgetc(file);
+            continue;
+        }
+        executeLine(line);
+    }
+
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+
+    setPathVariables();
+    loadBookmarksFromFile();
+    dropDependencyCycles();
+    atexit(shutdownShell);
+
+    if (argc > 1)
+    {
+        runScript(argv[1]);
+        return 0;
+    }
+
+    signal(SIGTSTP, sighandler);
+    char inputBuffer[MAX_LINE + 1];
+
+    // print opening text
+    printf("\033[1;31m");
+    printf("░█░░░█▀█░█░█░▀█▀░█▀▀░█░█░█▀▀░█░░░█░░\n");
+    printf("░█░░░█░█░█▀▄░░█░░▀▀█░█▀█░█▀▀░█░░░█░░\n");
+    printf("░▀▀▀░▀▀▀░▀░▀░▀▀▀░▀▀▀░▀░▀░▀▀▀░▀▀▀░▀▀▀\n");
+
+    while (1)
+    {
+        setup(inputBuffer);
+        executeLine(inputBuffer);
+    }
     return 0;
 }
@@ -0,0 +1,61 @@
+// Tokens-per-second benchmark for tokenize() and nextCommand().
+//
+//   gcc -O2 tools/bench_tokenize.c -o bench_tokenize
+//   ./bench_tokenize [iterations]
+//
+// Every iteration copies a line back into the buffer first, because tokenize() works in place.
+
+#define main lokishell_main
+#include "../lokishell.c"
+#undef main
+
+// A mix of the lines the shell sees interactively, in bookmarks and in scripts
+const char *benchmarkLines[] = {
+    "ls -l\n",
+    "cd /usr/local/src/project\n",
+    "gcc -O2 -Wall -o lokishell lokishell.c > build.log 2> errors.log\n",
+    "bookmark -n deploy -a build,test \"scp -r dist/ host:/srv/app && ssh host 'systemctl restart app'\"\n",
+    "echo \"hello   world\" 'single $quoted' escaped\\ space; cat < input.txt >> output.txt &\n",
+    "search -r \"int main\" # find every entry point\n",
+};
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    int lineCount = sizeof(benchmarkLines) / sizeof(benchmarkLines[0]);
+    size_t lengths[sizeof(benchmarkLines) / sizeof(benchmarkLines[0])];
+    char line[2 * MAX_LINE];
+    struct Token tokens[MAX_TOKENS];
+    struct Command command;
+    long tokenTotal = 0;
+    long commandTotal = 0;
+    size_t byteTotal = 0;
+    struct timespec start, end;
+
+    for (int i = 0; i < lineCount; i++)
+    {
+        lengths[i] = strlen(benchmarkLines[i]) + 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++)
+    {
+        int index = i % lineCount;
+        int position = 0;
+
+        memcpy(line, benchmarkLines[index], lengths[index]);
+        int tokenCount = tokenize(line, tokens, MAX_TOKENS);
+        while (nextCommand(tokens, tokenCount, &position, &command) > 0)
+        {
+            commandTotal++;
+        }
+        tokenTotal += tokenCount;
+        byteTotal += lengths[index] - 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(&start, &end);
+    printf("%ld lines, %ld tokens, %ld commands in %.3fs\n", iterations, tokenTotal, commandTotal, seconds);
+    printf("%.1f M tokens/s, %.1f MB/s\n", tokenTotal / seconds / 1e6, byteTotal / seconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Fuzz target for tokenize() and nextCommand().
+//
+// libFuzzer:
+//   clang -g -O1 -fsanitize=fuzzer,address,undefined tools/fuzz_tokenize.c -o fuzz_tokenize
+//   ./fuzz_tokenize [corpus directory]
+// Standalone, feeds random lines built from the characters the lexer cares about:
+//   gcc -g -O1 -fsanitize=address,undefined -DSTANDALONE_FUZZ tools/fuzz_tokenize.c -o fuzz_tokenize
+//   ./fuzz_tokenize [iterations] [seed]
+
+#define main lokishell_main
+#include "../lokishell.c"
+#undef main
+
+#include <stdint.h>
+
+// Aborts so that both libFuzzer and the standalone driver report the input
+#define FUZZ_CHECK(condition)                                                         \
+    do                                                                                \
+    {                                                                                 \
+        if (!(condition))                                                             \
+        {                                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
+    // tokenize() and nextCommand() report syntax errors on stdout
+    freopen("/dev/null", "w", stdout);
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *line = malloc(size + 1);
+    struct Token tokens[MAX_TOKENS];
+    struct Command command;
+    int position = 0;
+    int result;
+
+    memcpy(line, data, size);
+    line[size] = '\0';
+
+    int tokenCount = tokenize(line, tokens, MAX_TOKENS);
+    FUZZ_CHECK(tokenCount >= -1 && tokenCount <= MAX_TOKENS);
+
+    // Words must be terminated strings inside the line, operators have no text
+    for (int i = 0; i < tokenCount; i++)
+    {
+        if (tokens[i].type == TOKEN_WORD)
+        {
+            FUZZ_CHECK(tokens[i].text >= line && tokens[i].text <= line + size);
+            FUZZ_CHECK(memchr(tokens[i].text, '\0', line + size + 1 - tokens[i].text) != NULL);
+        }
+        else
+        {
+            FUZZ_CHECK(tokens[i].text == NULL);
+        }
+    }
+
+    while (tokenCount > 0 && (result = nextCommand(tokens, tokenCount, &position, &command)) != 0)
+    {
+        FUZZ_CHECK(position <= tokenCount);
+        if (result < 0)
+        {
+            while (position < tokenCount && tokens[position++].type != TOKEN_NEWLINE)
+                ;
+            continue;
+        }
+        FUZZ_CHECK(command.argCount >= 0 && command.argCount <= MAX_LINE / 2);
+        for (int i = 0; i < command.argCount; i++)
+        {
+            FUZZ_CHECK(command.args[i] >= line && command.args[i] <= line + size);
+        }
+    }
+
+    free(line);
+    return 0;
+}
+
+#ifdef STANDALONE_FUZZ
+int main(int argc, char *argv[])
+{
+    const char alphabet[] = " \t\n\\'\"&|;<>#2a-b";
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    unsigned int seed = argc > 2 ? (unsigned int)atol(argv[2]) : (unsigned int)time(NULL);
+    uint8_t input[4 * MAX_LINE];
+
+    LLVMFuzzerInitialize(&argc, &argv);
+    srand(seed);
+    fprintf(stderr, "seed %u, %ld iterations\n", seed, iterations);
+
+    for (long i = 0; i < iterations; i++)
+    {
+        size_t size = rand() % sizeof(input);
+        for (size_t j = 0; j < size; j++)
+        {
+            // Mostly lexer characters, with some arbitrary bytes
+            input[j] = rand() % 8 ? alphabet[rand() % (sizeof(alphabet) - 1)] : rand() % 256;
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+
+    fprintf(stderr, "done\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Soak test: runs a script of commands through lokishell's script mode and fails if the peak
+# resident set size of the shell passes a fixed ceiling, or if bookmark memory is still live at the end.
+#
+#   tools/soak.sh [lokishell binary] [commands] [RSS ceiling in kB]
+
+SHELL_BINARY=$(realpath "${1:-./lokishell}")
+COMMANDS=${2:-1000000}
+CEILING_KB=${3:-8192}
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR" || exit 1
+
+# Four builtin commands per line, replacing and deleting a bookmark so that it allocates and frees on
+# every line. Every 1000th line also forks an external command and runs a bookmark graph.
+awk -v lines=$((COMMANDS / 4)) 'BEGIN {
+    for (i = 1; i <= lines; i++) {
+        print "bookmark -n soak \"true\" > /dev/null; mem > /dev/null; cd . ; bookmark -d 0 > /dev/null"
+        if (i % 1000 == 0)
+            print "bookmark -n soak \"true\" > /dev/null; bookmark -r soak > /dev/null; bookmark -d 0 > /dev/null; true"
+    }
+    print "mem"
+}' > soak.lsh
+
+"$SHELL_BINARY" soak.lsh > soak.log 2>&1 &
+PID=$!
+
+# VmHWM is the peak resident set size so far, the last value read before the shell exits is its peak
+PEAK_KB=0
+while kill -0 $PID 2>/dev/null; do
+    HWM=$(awk '/^VmHWM:/ { print $2 }' /proc/$PID/status 2>/dev/null)
+    if [ -n "$HWM" ]; then
+        PEAK_KB=$HWM
+    fi
+    sleep 0.2
+done
+wait $PID
+STATUS=$?
+
+echo "peak RSS ${PEAK_KB} kB, ceiling ${CEILING_KB} kB"
+tail -n 3 soak.log
+
+if [ $STATUS -ne 0 ]; then
+    echo "FAIL: lokishell exited with status $STATUS"
+    exit 1
+fi
+if [ "$PEAK_KB" -eq 0 ] || [ "$PEAK_KB" -gt "$CEILING_KB" ]; then
+    echo "FAIL: peak RSS is over the ceiling"
+    exit 1
+fi
+if ! grep -q "^bookmarks  *0 bytes in 0 blocks" soak.log; then
+    echo "FAIL: bookmark memory is still live"
+    exit 1
+fi
+echo "PASS"